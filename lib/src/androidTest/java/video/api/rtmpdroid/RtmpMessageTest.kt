@@ -3,8 +3,12 @@ package video.api.rtmpdroid
 import org.junit.After
 import org.junit.Assert.assertArrayEquals
 import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertTrue
+import org.junit.Assert.fail
 import org.junit.Test
 import video.api.rtmpdroid.amf.AmfEncoder
+import java.net.SocketException
 import java.nio.ByteBuffer
 
 /**
@@ -52,6 +56,26 @@ class RtmpMessageTest {
         return buffer.array().sliceArray(IntRange(4, 4 + buffer.limit() - 1))
     }
 
+    private fun createAvcVideoBody(isKeyFrame: Boolean, compositionTime: Int, payload: ByteArray): ByteBuffer {
+        val buffer = ByteBuffer.allocateDirect(5 + payload.size)
+        buffer.put((if (isKeyFrame) 0x17 else 0x27).toByte())
+        buffer.put(1) // AVC NALU
+        buffer.put((compositionTime shr 16).toByte())
+        buffer.putShort(compositionTime.toShort())
+        buffer.put(payload)
+        buffer.rewind()
+        return buffer
+    }
+
+    private fun createAacAudioBody(payload: ByteArray): ByteBuffer {
+        val buffer = ByteBuffer.allocateDirect(2 + payload.size)
+        buffer.put(0xAF.toByte()) // AAC, 44 kHz, 16 bits, stereo
+        buffer.put(1) // AAC raw
+        buffer.put(payload)
+        buffer.rewind()
+        return buffer
+    }
+
     @After
     fun tearDown() {
         rtmp.close()
@@ -94,4 +118,118 @@ class RtmpMessageTest {
             resultBuffer.extractArray().sliceArray(IntRange(16, resultBuffer.limit() - 1))
         )
     }
+
+    @Test
+    fun readFrameTest() {
+        val futureData = rtmpServer.enqueuePlay(
+            listOf(
+                0 to createAvcVideoBody(true, 33, byteArrayOf(0, 0)),
+                66 to createAvcVideoBody(false, 0, byteArrayOf(2, 2)),
+                33 to createAvcVideoBody(false, 0, byteArrayOf(1)),
+                200 to createAvcVideoBody(false, 0, byteArrayOf(3, 3, 3))
+            )
+        )
+        Rtmp(enableWrite = false).use { player ->
+            player.jitterBufferDepth = 100
+            player.connect("rtmp://127.0.0.1:${rtmpServer.port}/app/playpath")
+            player.connectStream()
+            assertEquals(true, futureData.get())
+
+            // First frame (2 bytes) does not fit: forces buffer reallocation
+            val frame = RtmpFrame(1)
+            player.readFrame(frame)
+            assertEquals(FrameType.VIDEO, frame.type)
+            assertEquals(0, frame.timestamp)
+            assertEquals(33, frame.compositionTime)
+            assertTrue(frame.isKeyFrame)
+            assertFalse(frame.isConfig)
+            assertTrue(frame.buffer.capacity() >= 2)
+            assertArrayEquals(byteArrayOf(0, 0), frame.buffer.extractArray())
+
+            listOf(33 to byteArrayOf(1), 66 to byteArrayOf(2, 2), 200 to byteArrayOf(3, 3, 3))
+                .forEach { (timestamp, payload) ->
+                    player.readFrame(frame)
+                    assertEquals(timestamp, frame.timestamp)
+                    assertFalse(frame.isKeyFrame)
+                    assertArrayEquals(payload, frame.buffer.extractArray())
+                }
+
+            try {
+                player.readFrame(frame)
+                fail("readFrame must throw an exception at end of stream")
+            } catch (_: SocketException) {
+            }
+        }
+    }
+
+    @Test
+    fun readInterleavedFramesTest() {
+        val audio = RtmpServer.AUDIO_MESSAGE_TYPE
+        val video = RtmpServer.VIDEO_MESSAGE_TYPE
+        // Audio is a few ms behind video, then the publisher restarts its timestamps at 0
+        val expectedFrames = listOf(
+            Triple(video, 100_000, byteArrayOf(0)),
+            Triple(audio, 100_000, byteArrayOf(10)),
+            Triple(video, 100_033, byteArrayOf(1)),
+            Triple(audio, 100_021, byteArrayOf(11)),
+            Triple(video, 0, byteArrayOf(2)),
+            Triple(audio, 0, byteArrayOf(12)),
+            Triple(video, 33, byteArrayOf(3)),
+            Triple(audio, 21, byteArrayOf(13))
+        )
+        val futureData = rtmpServer.enqueuePlayMessages(
+            expectedFrames.map { (messageType, timestamp, payload) ->
+                val body = if (messageType == audio) {
+                    createAacAudioBody(payload)
+                } else {
+                    createAvcVideoBody(timestamp == 0, 0, payload)
+                }
+                Triple(messageType, timestamp, body)
+            }
+        )
+        Rtmp(enableWrite = false).use { player ->
+            assertEquals(0, player.jitterBufferDepth)
+            player.connect("rtmp://127.0.0.1:${rtmpServer.port}/app/playpath")
+            player.connectStream()
+            assertEquals(true, futureData.get())
+
+            // Depth is 0: frames are released in arrival order and none is dropped
+            val frame = RtmpFrame()
+            expectedFrames.forEach { (messageType, timestamp, payload) ->
+                player.readFrame(frame)
+                assertEquals(
+                    if (messageType == audio) FrameType.AUDIO else FrameType.VIDEO,
+                    frame.type
+                )
+                assertEquals(timestamp, frame.timestamp)
+                assertArrayEquals(payload, frame.buffer.extractArray())
+            }
+
+            try {
+                player.readFrame(frame)
+                fail("readFrame must throw an exception at end of stream")
+            } catch (_: SocketException) {
+            }
+        }
+    }
+
+    @Test
+    fun probeBandwidthTest() {
+        val bytesPerSecond = 64 * 1024
+        val futureData = rtmpServer.enqueueThrottledRead(bytesPerSecond)
+        rtmp.connect("rtmp://127.0.0.1:${rtmpServer.port}/app/playpath")
+        rtmp.connectStream()
+
+        val result = rtmp.probeBandwidth(500)
+        rtmp.close()
+
+        assertTrue(result.bytesSent > 0)
+        assertTrue(result.bytesAcked <= result.bytesSent)
+        assertTrue(result.rttInUs >= 0)
+        // Loose bounds: socket buffers absorb part of the burst
+        assertTrue(result.throughput > 0)
+        assertTrue(result.throughput < 4L * bytesPerSecond * 8)
+        assertTrue(result.recommendedBitrate() < result.throughput)
+        assertTrue(futureData.get() > 0)
+    }
 }
\ No newline at end of file
@@ -4,7 +4,9 @@ import android.os.ParcelFileDescriptor
 import video.api.rtmpdroid.amf.AmfEncoder
 import video.api.rtmpdroid.amf.models.NullParameter
 import video.api.rtmpdroid.amf.models.ObjectParameter
+import java.io.OutputStream
 import java.net.ServerSocket
+import java.net.SocketException
 import java.nio.ByteBuffer
 import java.util.concurrent.Callable
 import java.util.concurrent.Executors
@@ -44,7 +46,12 @@ class RtmpServer {
         rtmp.writePacket(packet)
     }
 
-    private fun sendOnStatus(rtmp: Rtmp, transactionId: Int) {
+    private fun sendOnStatus(
+        rtmp: Rtmp,
+        transactionId: Int,
+        code: String = "NetStream.Publish.Start",
+        description: String = "Publish started."
+    ) {
         val amfEncoder = AmfEncoder().apply {
             add("onStatus")
             add(0.0)
@@ -52,8 +59,8 @@ class RtmpServer {
             // Information
             val objectParameter = ObjectParameter()
             objectParameter.add("level", "status")
-            objectParameter.add("code", "NetStream.Publish.Start")
-            objectParameter.add("description", "Publish started.")
+            objectParameter.add("code", code)
+            objectParameter.add("description", description)
             add(objectParameter)
         }
         val body = amfEncoder.encode()
@@ -73,6 +80,19 @@ class RtmpServer {
         sendOnStatus(rtmp, 5)
     }
 
+    private fun playServer(rtmp: Rtmp, fd: Int) {
+        rtmp.serve(fd)
+        var packet = rtmp.readPacket() // connect
+        sendConnectResult(rtmp, 1)
+        packet = rtmp.readPacket() // Window Acknowledgement Size
+        packet = rtmp.readPacket() // User Control Message: Set Buffer Length
+        packet = rtmp.readPacket() // createStream
+        sendResultNumber(rtmp, 2, 1) // createStream - result
+        packet = rtmp.readPacket() // play
+        packet = rtmp.readPacket() // User Control Message: Set Buffer Length
+        sendOnStatus(rtmp, 0, "NetStream.Play.Start", "Play started.")
+    }
+
     fun enqueueConnect(): Future<Boolean> {
         return executor.submit(Callable {
             val clientSocket = serverSocket.accept()
@@ -94,8 +114,109 @@ class RtmpServer {
         })
     }
 
+    /**
+     * Writes an audio or video message in a single chunk with a full header, so that its timestamp
+     * is sent. [Rtmp.writePacket] always sends a 0 timestamp.
+     */
+    private fun writeMediaMessage(
+        outputStream: OutputStream,
+        messageType: Int,
+        timestamp: Int,
+        body: ByteBuffer
+    ) {
+        val size = body.remaining()
+        require(size <= DEFAULT_CHUNK_SIZE) { "Media message must fit in a single chunk" }
+        val header = byteArrayOf(
+            0x04, // Chunk type 0, chunk stream ID 4
+            (timestamp shr 16).toByte(), (timestamp shr 8).toByte(), timestamp.toByte(),
+            (size shr 16).toByte(), (size shr 8).toByte(), size.toByte(),
+            messageType.toByte(),
+            0, 0, 0, 0 // Message stream ID
+        )
+        val payload = ByteArray(size)
+        body.duplicate().get(payload)
+        outputStream.write(header + payload)
+    }
+
+    /**
+     * Sends the video messages to a playing client.
+     *
+     * @param packets list of timestamp to video message body
+     */
+    fun enqueuePlay(packets: List<Pair<Int, ByteBuffer>>): Future<Boolean> {
+        return enqueuePlayMessages(packets.map { (timestamp, body) ->
+            Triple(VIDEO_MESSAGE_TYPE, timestamp, body)
+        })
+    }
+
+    /**
+     * Sends the audio and video messages to a playing client, in order.
+     *
+     * @param messages list of message type ([AUDIO_MESSAGE_TYPE] or [VIDEO_MESSAGE_TYPE]),
+     * timestamp and message body
+     */
+    fun enqueuePlayMessages(messages: List<Triple<Int, Int, ByteBuffer>>): Future<Boolean> {
+        return executor.submit(Callable {
+            val clientSocket = serverSocket.accept()
+            Rtmp().use {
+                playServer(it, ParcelFileDescriptor.fromSocket(clientSocket).detachFd())
+                val outputStream = clientSocket.getOutputStream()
+                messages.forEach { (messageType, timestamp, body) ->
+                    writeMediaMessage(outputStream, messageType, timestamp, body)
+                }
+                outputStream.flush()
+            }
+            true
+        })
+    }
+
+    /**
+     * Reads raw bytes after the publish handshake at a limited rate, to emulate a slow uplink.
+     *
+     * @param bytesPerSecond read rate
+     * @return number of bytes read until the client closes the connection
+     */
+    fun enqueueThrottledRead(bytesPerSecond: Int): Future<Long> {
+        // Must be set before accept() to be applied to the TCP window of the accepted socket
+        serverSocket.receiveBufferSize = 4096
+        return executor.submit(Callable {
+            val clientSocket = serverSocket.accept()
+            Rtmp().use {
+                invokeServer(it, ParcelFileDescriptor.fromSocket(clientSocket).detachFd())
+
+                val inputStream = clientSocket.getInputStream()
+                val buffer = ByteArray(1024)
+                var totalRead = 0L
+                val startTime = System.nanoTime()
+                try {
+                    while (true) {
+                        val read = inputStream.read(buffer)
+                        if (read < 0) {
+                            break
+                        }
+                        totalRead += read
+                        val expectedTimeInMs = totalRead * 1000 / bytesPerSecond
+                        val elapsedTimeInMs = (System.nanoTime() - startTime) / 1_000_000
+                        if (expectedTimeInMs > elapsedTimeInMs) {
+                            Thread.sleep(expectedTimeInMs - elapsedTimeInMs)
+                        }
+                    }
+                } catch (_: SocketException) {
+                }
+                totalRead
+            }
+        })
+    }
+
     fun shutdown() {
         serverSocket.close()
         executor.shutdown()
     }
+
+    companion object {
+        private const val DEFAULT_CHUNK_SIZE = 128
+
+        const val AUDIO_MESSAGE_TYPE = 0x08
+        const val VIDEO_MESSAGE_TYPE = 0x09
+    }
 }
\ No newline at end of file
@@ -44,6 +44,13 @@ class RtmpTest {
         assertTrue(rtmp.supportedVideoCodecs.contains(MediaFormat.MIMETYPE_VIDEO_HEVC))
     }
 
+    @Test
+    fun jitterBufferDepthTest() {
+        val depth = 500
+        rtmp.jitterBufferDepth = depth
+        assertEquals(depth, rtmp.jitterBufferDepth)
+    }
+
     @Test
     fun connectTest() {
         try {
@@ -77,6 +84,14 @@ class RtmpTest {
         }
     }
 
+    @Test
+    fun readFrameTest() {
+        try {
+            rtmp.readFrame(RtmpFrame())
+        } catch (_: SocketException) {
+        }
+    }
+
     @Test
     fun writeByteBufferTest() {
         val buffer = ByteBuffer.allocateDirect(10)
@@ -95,6 +110,15 @@ class RtmpTest {
         }
     }
 
+    @Test
+    fun probeBandwidthTest() {
+        try {
+            rtmp.probeBandwidth()
+            fail("probeBandwidth must throw an exception if not connected")
+        } catch (_: SocketException) {
+        }
+    }
+
     @Test
     fun pauseTest() {
         try {
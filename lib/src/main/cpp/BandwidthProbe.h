@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/sockios.h>
+
+#include "librtmp/rtmp.h"
+
+#include "Log.h"
+
+#define PROBE_CHANNEL 0x02 // Protocol control channel
+#define PROBE_MESSAGE_SIZE 4096
+#define PROBE_DRAIN_POLL_US 1000
+// Padding bytes not yet sent allowed in the socket send queue: bounds what the first media frame
+// waits for. Bytes in flight are not limited, so the probe can fill the link.
+#define PROBE_MAX_NOT_SENT_BYTES (32 * 1024)
+
+#ifndef SIOCOUTQNSD
+#define SIOCOUTQNSD 0x894B // Linux 3.12+
+#endif
+
+/**
+ * User control event type that is not defined by the RTMP specification: servers ignore it.
+ */
+#define PROBE_USER_CONTROL_EVENT 0x7f
+
+typedef struct bandwidth_probe_result {
+    int64_t bytes_sent;
+    int64_t bytes_acked;
+    int64_t duration_us;
+    int64_t rtt_us;
+    int64_t rtt_var_us;
+} bandwidth_probe_result;
+
+/**
+ * Measures the uplink throughput by sending padding user control messages and watching the socket
+ * send queue drain.
+ *
+ * Byte counts are RTMP bytes on the wire (chunk headers included), as reported by `SIOCOUTQ`.
+ * TCP/IP headers and retransmissions are not counted, so the throughput is slightly underestimated.
+ */
+class BandwidthProbe {
+public:
+    /**
+     * Runs the probe. It sends up to `maxBytes` of padding for at most `durationInMs`, keeping at
+     * most PROBE_MAX_NOT_SENT_BYTES not sent yet in the socket send queue, then waits up to `durationInMs` more
+     * for the socket send queue to drain.
+     *
+     * @return 0 on success, a negative value otherwise
+     */
+    static int run(RTMP *rtmp, int durationInMs, int64_t maxBytes, bandwidth_probe_result *result) {
+        if (!RTMP_IsConnected(rtmp)) {
+            return -ENOTCONN;
+        }
+        int fd = RTMP_Socket(rtmp);
+
+        // Bytes queued before the probe are sent during the probe too
+        int queued = 0;
+        int res = getQueuedBytes(fd, SIOCOUTQ, &queued);
+        if (res != 0) {
+            return res;
+        }
+        int notSent = 0;
+
+        char *pbuf = static_cast<char *>(malloc(RTMP_MAX_HEADER_SIZE + PROBE_MESSAGE_SIZE));
+        if (pbuf == nullptr) {
+            LOGE("Not enough memory");
+            return -ENOMEM;
+        }
+        char *body = pbuf + RTMP_MAX_HEADER_SIZE;
+        memset(body, 0, PROBE_MESSAGE_SIZE);
+        body[1] = PROBE_USER_CONTROL_EVENT;
+
+        int64_t durationUs = (int64_t) durationInMs * 1000;
+        int64_t startUs = nowUs();
+        int64_t bytesSent = queued;
+        int64_t paddingSent = 0;
+        while ((paddingSent < maxBytes) && (nowUs() - startUs < durationUs)) {
+            // Pace on bytes not sent yet, so that little padding is left ahead of the first media
+            // frame. Bytes sent but not acknowledged yet do not delay it.
+            res = getQueuedBytes(fd, SIOCOUTQNSD, &notSent);
+            if (res != 0) {
+                free(pbuf);
+                return res;
+            }
+            if (notSent > PROBE_MAX_NOT_SENT_BYTES) {
+                usleep(PROBE_DRAIN_POLL_US);
+                continue;
+            }
+
+            int size = (int) std::min<int64_t>(PROBE_MESSAGE_SIZE, maxBytes - paddingSent);
+            if (size < 2) {
+                break;
+            }
+
+            RTMPPacket packet = {0};
+            packet.m_nChannel = PROBE_CHANNEL;
+            packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+            packet.m_packetType = RTMP_PACKET_TYPE_CONTROL;
+            packet.m_body = body;
+            packet.m_nBodySize = size;
+
+            if (!RTMP_SendPacket(rtmp, &packet, FALSE)) {
+                LOGE("Can't send probe padding");
+                free(pbuf);
+                return -1;
+            }
+            paddingSent += size;
+            bytesSent += getWireSize(rtmp, &packet);
+        }
+        free(pbuf);
+
+        // Bytes still in the send queue have not been acknowledged by the peer yet
+        int unsent = 0;
+        while (true) {
+            res = getQueuedBytes(fd, SIOCOUTQ, &unsent);
+            if (res != 0) {
+                return res;
+            }
+            if ((unsent <= 0) || (nowUs() - startUs >= 2 * durationUs)) {
+                break;
+            }
+            usleep(PROBE_DRAIN_POLL_US);
+        }
+
+        result->bytes_sent = bytesSent;
+        result->bytes_acked = std::max<int64_t>(0, bytesSent - unsent);
+        result->duration_us = nowUs() - startUs;
+
+        struct tcp_info info = {0};
+        socklen_t len = sizeof(info);
+        if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+            result->rtt_us = info.tcpi_rtt;
+            result->rtt_var_us = info.tcpi_rttvar;
+        } else {
+            LOGW("Can't get TCP_INFO: %s", strerror(errno));
+            result->rtt_us = -1;
+            result->rtt_var_us = -1;
+        }
+
+        return 0;
+    }
+
+private:
+    static int64_t nowUs() {
+        struct timespec ts = {0};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    /**
+     * Gets the number of bytes in the socket send queue: not acknowledged yet with SIOCOUTQ, not
+     * sent yet with SIOCOUTQNSD.
+     *
+     * @return 0 on success, a negative errno otherwise
+     */
+    static int getQueuedBytes(int fd, int request, int *queued) {
+        if (ioctl(fd, request, queued) != 0) {
+            int err = errno;
+            LOGE("Can't get socket send queue size: %s", strerror(err));
+            return -err;
+        }
+        return 0;
+    }
+
+    /**
+     * Size of a sent packet on the wire: RTMP_SendPacket compresses the header in place, and adds
+     * a 1-byte header to each following chunk.
+     */
+    static int64_t getWireSize(RTMP *rtmp, const RTMPPacket *packet) {
+        static const int headerSizes[] = {12, 8, 4, 1};
+        int64_t continuationChunks = (packet->m_nBodySize - 1) / rtmp->m_outChunkSize;
+        return headerSizes[packet->m_headerType] + packet->m_nBodySize + continuationChunks;
+    }
+};
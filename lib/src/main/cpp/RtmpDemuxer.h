@@ -0,0 +1,430 @@
+#pragma once
+
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include "librtmp/rtmp.h"
+#include "librtmp/amf.h"
+
+#include "Log.h"
+
+// Must match video.api.rtmpdroid.FrameType
+#define FRAME_TYPE_AUDIO 0
+#define FRAME_TYPE_VIDEO 1
+#define FRAME_TYPE_METADATA 2
+#define FRAME_TYPE_COUNT 3
+
+#define DEMUXER_DEFAULT_DEPTH_MS 0
+#define DEMUXER_MAX_SPARE_BUFFERS 16
+// Release frames regardless of the depth when the jitter buffer grows beyond these limits
+#define DEMUXER_MAX_FRAMES 1024
+#define DEMUXER_MAX_BYTES (16 * 1024 * 1024)
+// A track going back in time by more than this is a new timeline (publisher restart, wrap,...)
+#define DEMUXER_MAX_BACKWARD_JUMP_MS 10000
+
+#define FLV_TAG_HEADER_SIZE 11
+#define FLV_PREVIOUS_TAG_SIZE 4
+
+#define FLV_AUDIO_CODEC_AAC 10
+#define FLV_VIDEO_CODEC_AVC 7
+#define FLV_VIDEO_FRAME_KEY 1
+#define FLV_VIDEO_FRAME_COMMAND 5
+
+#define FOURCC(a, b, c, d) (((uint32_t) (a) << 24) | ((uint32_t) (b) << 16) | ((uint32_t) (c) << 8) | (uint32_t) (d))
+
+// Enhanced RTMP video packet types
+#define EX_VIDEO_PACKET_SEQUENCE_START 0
+#define EX_VIDEO_PACKET_CODED_FRAMES 1
+#define EX_VIDEO_PACKET_CODED_FRAMES_X 3
+
+typedef struct demuxed_frame {
+    int type;
+    int32_t codec;
+    uint32_t timestamp;
+    uint32_t timeline;
+    int32_t composition_time;
+    bool is_key_frame;
+    bool is_config;
+    std::vector<uint8_t> data;
+} demuxed_frame;
+
+/**
+ * Reads RTMP messages of a played stream and demuxes audio, video and metadata into a jitter buffer
+ * ordered by timestamp.
+ *
+ * A frame is released once the jitter buffer spans at least `depth` ms, so that late messages can
+ * still be inserted at their place. Frames older than the last released frame of the same track are
+ * dropped.
+ *
+ * A timestamp discontinuity (NetStream.Play.Reset or NetStream.Play.Start, or a large backward jump
+ * of a track) starts a new timeline: its frames are released after the frames of the previous one.
+ */
+class RtmpDemuxer {
+public:
+    explicit RtmpDemuxer(RTMP *rtmp) : rtmp(rtmp) {}
+
+    void setDepth(uint32_t depthInMs) {
+        depth = depthInMs;
+    }
+
+    uint32_t getDepth() const {
+        return depth;
+    }
+
+    /**
+     * Gets the oldest frame of the jitter buffer, reading from the network as long as the jitter
+     * buffer is not deep enough. The frame stays in the jitter buffer until [pop] is called.
+     *
+     * @return 1 if a frame is available, 0 on timeout and -1 on error or end of stream
+     */
+    int peek(demuxed_frame **frame) {
+        if (isHeld && !frames.empty()) {
+            // Same frame as the previous call: do not read from the network
+            *frame = &frames.front();
+            return 1;
+        }
+
+        while (!isReady() && !endOfStream) {
+            int res = readMessage();
+            if (res < 0) {
+                endOfStream = true;
+            } else if (res == 0) {
+                if (frames.empty()) {
+                    return 0;
+                }
+                break; // Underflow: deliver what we have
+            }
+        }
+
+        if (frames.empty()) {
+            return -1;
+        }
+
+        *frame = &frames.front();
+        return 1;
+    }
+
+    /**
+     * Keeps the frame returned by [peek] so that next [peek] returns it again without reading from
+     * the network.
+     */
+    void hold() {
+        isHeld = true;
+    }
+
+    /**
+     * Removes the oldest frame of the jitter buffer and keeps its storage for next frames.
+     */
+    void pop() {
+        if (frames.empty()) {
+            return;
+        }
+
+        isHeld = false;
+        const demuxed_frame &front = frames.front();
+        if (front.timeline == timeline) {
+            hasReleased[front.type] = true;
+            lastReleasedTimestamp[front.type] = front.timestamp;
+        }
+        bufferedBytes -= front.data.size();
+
+        if (spareBuffers.size() < DEMUXER_MAX_SPARE_BUFFERS) {
+            frames.front().data.clear();
+            spareBuffers.push_back(std::move(frames.front().data));
+        }
+        frames.pop_front();
+    }
+
+private:
+    RTMP *rtmp;
+    uint32_t depth = DEMUXER_DEFAULT_DEPTH_MS;
+    bool endOfStream = false;
+    bool isHeld = false;
+    uint32_t timeline = 0;
+    // Per track (frame type) state of the current timeline
+    bool hasPushed[FRAME_TYPE_COUNT] = {false};
+    uint32_t lastPushedTimestamp[FRAME_TYPE_COUNT] = {0};
+    bool hasReleased[FRAME_TYPE_COUNT] = {false};
+    uint32_t lastReleasedTimestamp[FRAME_TYPE_COUNT] = {0};
+    uint32_t droppedFrames = 0;
+    size_t bufferedBytes = 0;
+    std::deque<demuxed_frame> frames;
+    std::vector<std::vector<uint8_t>> spareBuffers;
+
+    bool isReady() const {
+        if (frames.empty()) {
+            return false;
+        }
+        if (endOfStream || (frames.size() >= DEMUXER_MAX_FRAMES) ||
+            (bufferedBytes >= DEMUXER_MAX_BYTES)) {
+            return true;
+        }
+        if (frames.front().timeline != frames.back().timeline) {
+            // Release the previous timeline first
+            return true;
+        }
+        // frames are sorted, so the jitter buffer spans from the front to the back
+        return frames.back().timestamp - frames.front().timestamp >= depth;
+    }
+
+    void startTimeline() {
+        timeline++;
+        for (int i = 0; i < FRAME_TYPE_COUNT; i++) {
+            hasPushed[i] = false;
+            hasReleased[i] = false;
+        }
+    }
+
+    static bool isAValEqual(const AVal &aval, const char *str) {
+        size_t len = strlen(str);
+        return (aval.av_len == (int) len) && (memcmp(aval.av_val, str, len) == 0);
+    }
+
+    /**
+     * Starts a new timeline on NetStream.Play.Reset and NetStream.Play.Start: the publisher may have
+     * restarted its timestamps.
+     */
+    void demuxCommand(const uint8_t *body, uint32_t size) {
+        AMFObject obj;
+        if (AMF_Decode(&obj, (const char *) body, (int) size, FALSE) < 0) {
+            return;
+        }
+
+        AVal method = {nullptr, 0};
+        AMFProp_GetString(AMF_GetProp(&obj, nullptr, 0), &method);
+        if (isAValEqual(method, "onStatus")) {
+            AMFObject info;
+            AVal codeName = {const_cast<char *>("code"), 4};
+            AVal code = {nullptr, 0};
+            AMFProp_GetObject(AMF_GetProp(&obj, nullptr, 3), &info);
+            AMFProp_GetString(AMF_GetProp(&info, &codeName, -1), &code);
+            if (isAValEqual(code, "NetStream.Play.Reset") ||
+                isAValEqual(code, "NetStream.Play.Start")) {
+                startTimeline();
+            }
+        }
+        AMF_Reset(&obj);
+    }
+
+    static int32_t decodeSInt24(const uint8_t *data) {
+        int32_t value = (int32_t) AMF_DecodeInt24((const char *) data);
+        if (value & 0x800000) {
+            value |= (int32_t) 0xff000000;
+        }
+        return value;
+    }
+
+    /**
+     * Reads RTMP chunks until a complete message has been received and demuxes it.
+     *
+     * @return 1 on success, 0 on timeout and -1 on error or end of stream
+     */
+    int readMessage() {
+        RTMPPacket packet = {0};
+
+        while (RTMP_IsConnected(rtmp) && RTMP_ReadPacket(rtmp, &packet)) {
+            if (!RTMPPacket_IsReady(&packet) || !packet.m_nBodySize) {
+                continue;
+            }
+
+            // Let librtmp handle chunk size, acknowledgement, ping and commands
+            int res = RTMP_ClientPacket(rtmp, &packet);
+            if (res == 2) {
+                // NetStream.Play.Stop or NetStream.Play.Complete
+                RTMPPacket_Free(&packet);
+                return -1;
+            }
+
+            demuxMessage(packet.m_packetType, reinterpret_cast<uint8_t *>(packet.m_body),
+                         packet.m_nBodySize, packet.m_nTimeStamp);
+            RTMPPacket_Free(&packet);
+            return 1;
+        }
+
+        if (RTMP_IsTimedout(rtmp)) {
+            return 0;
+        }
+        return -1;
+    }
+
+    void demuxMessage(uint8_t packetType, const uint8_t *body, uint32_t size, uint32_t timestamp) {
+        switch (packetType) {
+            case RTMP_PACKET_TYPE_AUDIO:
+                demuxAudio(body, size, timestamp);
+                break;
+            case RTMP_PACKET_TYPE_VIDEO:
+                demuxVideo(body, size, timestamp);
+                break;
+            case RTMP_PACKET_TYPE_INFO:
+                push(FRAME_TYPE_METADATA, 0, timestamp, 0, false, false, body, size);
+                break;
+            case RTMP_PACKET_TYPE_FLASH_VIDEO:
+                demuxAggregate(body, size, timestamp);
+                break;
+            case RTMP_PACKET_TYPE_INVOKE:
+                demuxCommand(body, size);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void demuxAudio(const uint8_t *body, uint32_t size, uint32_t timestamp) {
+        if (size < 1) {
+            return;
+        }
+
+        int32_t codec = body[0] >> 4;
+        if (codec == FLV_AUDIO_CODEC_AAC) {
+            if (size < 2) {
+                return;
+            }
+            push(FRAME_TYPE_AUDIO, codec, timestamp, 0, true, body[1] == 0, &body[2], size - 2);
+        } else {
+            push(FRAME_TYPE_AUDIO, codec, timestamp, 0, true, false, &body[1], size - 1);
+        }
+    }
+
+    void demuxVideo(const uint8_t *body, uint32_t size, uint32_t timestamp) {
+        if (size < 1) {
+            return;
+        }
+
+        bool isExHeader = (body[0] & 0x80) != 0;
+        if (isExHeader) {
+            // Enhanced RTMP: [IsExHeader | FrameType:3 | PacketType:4] [FourCC:32]
+            if (size < 5) {
+                return;
+            }
+            int frameType = (body[0] >> 4) & 0x07;
+            int packetType = body[0] & 0x0f;
+            int32_t fourCC = (int32_t) AMF_DecodeInt32((const char *) &body[1]);
+            bool isKeyFrame = frameType == FLV_VIDEO_FRAME_KEY;
+            if (frameType == FLV_VIDEO_FRAME_COMMAND) {
+                return;
+            }
+
+            switch (packetType) {
+                case EX_VIDEO_PACKET_SEQUENCE_START:
+                    push(FRAME_TYPE_VIDEO, fourCC, timestamp, 0, isKeyFrame, true, &body[5],
+                         size - 5);
+                    break;
+                case EX_VIDEO_PACKET_CODED_FRAMES:
+                    if ((uint32_t) fourCC == FOURCC('h', 'v', 'c', '1')) {
+                        // Only HEVC carries a composition time offset
+                        if (size < 8) {
+                            return;
+                        }
+                        push(FRAME_TYPE_VIDEO, fourCC, timestamp, decodeSInt24(&body[5]),
+                             isKeyFrame, false, &body[8], size - 8);
+                    } else {
+                        push(FRAME_TYPE_VIDEO, fourCC, timestamp, 0, isKeyFrame, false, &body[5],
+                             size - 5);
+                    }
+                    break;
+                case EX_VIDEO_PACKET_CODED_FRAMES_X:
+                    push(FRAME_TYPE_VIDEO, fourCC, timestamp, 0, isKeyFrame, false, &body[5],
+                         size - 5);
+                    break;
+                default:
+                    // Sequence end, metadata,...
+                    break;
+            }
+        } else {
+            // Legacy FLV: [FrameType:4 | CodecId:4]
+            int frameType = body[0] >> 4;
+            int32_t codec = body[0] & 0x0f;
+            bool isKeyFrame = frameType == FLV_VIDEO_FRAME_KEY;
+            if (frameType == FLV_VIDEO_FRAME_COMMAND) {
+                return;
+            }
+
+            if (codec == FLV_VIDEO_CODEC_AVC) {
+                // [AVCPacketType:8] [CompositionTime:SI24]
+                if ((size < 5) || (body[1] > 1)) {
+                    return; // Truncated or end of sequence
+                }
+                push(FRAME_TYPE_VIDEO, codec, timestamp, decodeSInt24(&body[2]), isKeyFrame,
+                     body[1] == 0, &body[5], size - 5);
+            } else {
+                push(FRAME_TYPE_VIDEO, codec, timestamp, 0, isKeyFrame, false, &body[1],
+                     size - 1);
+            }
+        }
+    }
+
+    void demuxAggregate(const uint8_t *body, uint32_t size, uint32_t timestamp) {
+        // Aggregate message is a list of FLV tags. Their timestamps are relative to the first one.
+        uint32_t offset = 0;
+        uint32_t firstTagTimestamp = 0;
+        bool isFirstTag = true;
+
+        while (offset + FLV_TAG_HEADER_SIZE <= size) {
+            const uint8_t *tag = &body[offset];
+            uint8_t tagType = tag[0] & 0x1f;
+            uint32_t dataSize = AMF_DecodeInt24((const char *) &tag[1]);
+            uint32_t tagTimestamp =
+                    AMF_DecodeInt24((const char *) &tag[4]) | ((uint32_t) tag[7] << 24);
+
+            if (offset + FLV_TAG_HEADER_SIZE + dataSize > size) {
+                LOGW("Truncated aggregate message");
+                break;
+            }
+            if (isFirstTag) {
+                firstTagTimestamp = tagTimestamp;
+                isFirstTag = false;
+            }
+
+            demuxMessage(tagType, &tag[FLV_TAG_HEADER_SIZE], dataSize,
+                         timestamp + (tagTimestamp - firstTagTimestamp));
+
+            offset += FLV_TAG_HEADER_SIZE + dataSize + FLV_PREVIOUS_TAG_SIZE;
+        }
+    }
+
+    void push(int type, int32_t codec, uint32_t timestamp, int32_t compositionTime,
+              bool isKeyFrame, bool isConfig, const uint8_t *data, uint32_t size) {
+        if (hasPushed[type] && (timestamp < lastPushedTimestamp[type]) &&
+            (lastPushedTimestamp[type] - timestamp > DEMUXER_MAX_BACKWARD_JUMP_MS)) {
+            LOGI("Timestamp discontinuity: %u -> %u", lastPushedTimestamp[type], timestamp);
+            startTimeline();
+        }
+        if (hasReleased[type] && (timestamp < lastReleasedTimestamp[type])) {
+            // Too late: frames of this track with a greater timestamp have already been released
+            droppedFrames++;
+            LOGW("Dropping late frame with timestamp %u (%u dropped frames)", timestamp,
+                 droppedFrames);
+            return;
+        }
+        hasPushed[type] = true;
+        lastPushedTimestamp[type] = timestamp;
+
+        demuxed_frame frame;
+        frame.type = type;
+        frame.codec = codec;
+        frame.timestamp = timestamp;
+        frame.timeline = timeline;
+        frame.composition_time = compositionTime;
+        frame.is_key_frame = isKeyFrame;
+        frame.is_config = isConfig;
+        if (!spareBuffers.empty()) {
+            frame.data = std::move(spareBuffers.back());
+            spareBuffers.pop_back();
+        }
+        frame.data.assign(data, data + size);
+
+        // Messages are mostly in order: look for the insertion point from the back, without
+        // crossing into a previous timeline
+        auto it = frames.end();
+        while ((it != frames.begin()) && (std::prev(it)->timeline == timeline) &&
+               (std::prev(it)->timestamp > timestamp)) {
+            --it;
+        }
+        bufferedBytes += size;
+        frames.insert(it, std::move(frame));
+    }
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+/**
+ * Tracing spans for connection phases and frame sends.
+ *
+ * Spans go to ATrace so they show up in Perfetto/systrace captures (API 23+). When no capture is
+ * running, a span costs a call to ATrace_isEnabled.
+ *
+ * Without RTMPDROID_TRACING, TRACE_* macros compile to nothing.
+ */
+
+#ifdef RTMPDROID_TRACING
+
+#include <dlfcn.h>
+
+#include "librtmp/trace.h"
+
+// ATrace NDK API is only available from API 23: resolve it at runtime
+static bool (*atrace_is_enabled)() = nullptr;
+static void (*atrace_begin_section)(const char *) = nullptr;
+static void (*atrace_end_section)() = nullptr;
+
+static void trace_begin(const char *name) {
+    if (atrace_is_enabled()) {
+        atrace_begin_section(name);
+    }
+}
+
+static void trace_end() {
+    if (atrace_is_enabled()) {
+        atrace_end_section();
+    }
+}
+
+static void trace_init() {
+    void *lib = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+    if (lib == nullptr) {
+        return;
+    }
+
+    atrace_begin_section = reinterpret_cast<void (*)(const char *)>(dlsym(lib,
+                                                                          "ATrace_beginSection"));
+    atrace_end_section = reinterpret_cast<void (*)()>(dlsym(lib, "ATrace_endSection"));
+    atrace_is_enabled = reinterpret_cast<bool (*)()>(dlsym(lib, "ATrace_isEnabled"));
+    if ((atrace_begin_section == nullptr) || (atrace_end_section == nullptr) ||
+        (atrace_is_enabled == nullptr)) {
+        atrace_is_enabled = nullptr;
+        return;
+    }
+
+    RTMP_TraceSetCallbacks(&trace_begin, &trace_end);
+}
+
+#define TRACE_BEGIN(name) do { if (atrace_is_enabled) trace_begin(name); } while (0)
+#define TRACE_END() do { if (atrace_is_enabled) trace_end(); } while (0)
+
+#define TRACE_INIT() trace_init()
+
+#else
+
+#define TRACE_INIT()
+#define TRACE_BEGIN(name)
+#define TRACE_END()
+
+#endif
@@ -1,6 +1,7 @@
 #include <jni.h>
 #include <string.h>
 #include <errno.h>
+#include <new>
 
 #include "librtmp/rtmp.h"
 #include "librtmp/log.h"
@@ -8,6 +9,11 @@
 #include "models/RtmpWrapper.h"
 #include "Log.h"
 #include "models/RtmpPacket.h"
+#include "models/RtmpFrame.h"
+#include "models/BandwidthProbeResult.h"
+#include "RtmpDemuxer.h"
+#include "BandwidthProbe.h"
+#include "Trace.h"
 
 #define RTMP_CLASS "video/api/rtmpdroid/Rtmp"
 #define AMF_ENCODER_CLASS "video/api/rtmpdroid/amf/AmfEncoder"
@@ -26,6 +32,7 @@ nativeAlloc(JNIEnv *env, jobject thiz) {
         return 0;
     }
     rtmp_context->rtmp = rtmp;
+    rtmp_context->demuxer = nullptr;
     return reinterpret_cast<jlong>(rtmp_context);
 }
 
@@ -62,7 +69,9 @@ nativeConnect(JNIEnv *env, jobject thiz) {
         return -EFAULT;
     }
 
+    TRACE_BEGIN("rtmp.connect");
     int res = RTMP_Connect(rtmp_context->rtmp, nullptr);
+    TRACE_END();
     if (res == FALSE) {
         LOGE("Can't connect");
         return -1;
@@ -223,7 +232,9 @@ nativeWrite(JNIEnv *env, jobject thiz, jbyteArray data, jint offset, jint size)
 
     char *buf = (char *) env->GetByteArrayElements(data, nullptr);
 
+    TRACE_BEGIN("rtmp.write");
     int res = RTMP_Write(rtmp_context->rtmp, &buf[offset], size);
+    TRACE_END();
 
     env->ReleaseByteArrayElements(data, (jbyte *) buf, 0);
 
@@ -239,7 +250,9 @@ nativeWriteA(JNIEnv *env, jobject thiz, jobject buffer, jint offset, jint size)
 
     char *buf = (char *) env->GetDirectBufferAddress(buffer);
 
+    TRACE_BEGIN("rtmp.write");
     int res = RTMP_Write(rtmp_context->rtmp, &buf[offset], size);
+    TRACE_END();
 
     return res;
 }
@@ -301,11 +314,100 @@ nativeReadPacket(JNIEnv *env, jobject thiz) {
     return RtmpPacket::getJava(env, rtmp_packet);
 }
 
+static RtmpDemuxer *getDemuxer(rtmp_context *rtmp_context) {
+    if (rtmp_context->demuxer == nullptr) {
+        rtmp_context->demuxer = new(std::nothrow) RtmpDemuxer(rtmp_context->rtmp);
+    }
+    return rtmp_context->demuxer;
+}
+
+JNIEXPORT int JNICALL
+nativeSetJitterBufferDepth(JNIEnv *env, jobject thiz, jint depthInMs) {
+    rtmp_context *rtmp_context = RtmpWrapper::getNative(env, thiz);
+    if (rtmp_context == nullptr) {
+        return -EFAULT;
+    }
+
+    RtmpDemuxer *demuxer = getDemuxer(rtmp_context);
+    if (demuxer == nullptr) {
+        return -ENOMEM;
+    }
+
+    demuxer->setDepth(depthInMs);
+    return 0;
+}
+
+JNIEXPORT jint JNICALL
+nativeGetJitterBufferDepth(JNIEnv *env, jobject thiz) {
+    rtmp_context *rtmp_context = RtmpWrapper::getNative(env, thiz);
+    if (rtmp_context == nullptr) {
+        return -EFAULT;
+    }
+
+    if (rtmp_context->demuxer == nullptr) {
+        return DEMUXER_DEFAULT_DEPTH_MS;
+    }
+    return (jint) rtmp_context->demuxer->getDepth();
+}
+
+JNIEXPORT jint JNICALL
+nativeReadFrame(JNIEnv *env, jobject thiz, jobject rtmpFrame) {
+    rtmp_context *rtmp_context = RtmpWrapper::getNative(env, thiz);
+    if (rtmp_context == nullptr) {
+        return -EFAULT;
+    }
+
+    RtmpDemuxer *demuxer = getDemuxer(rtmp_context);
+    if (demuxer == nullptr) {
+        return -ENOMEM;
+    }
+
+    demuxed_frame *frame = nullptr;
+    int res = demuxer->peek(&frame);
+    if (res == 0) {
+        return -ETIMEDOUT;
+    } else if (res < 0) {
+        return -1;
+    }
+
+    res = RtmpFrame::setJava(env, rtmpFrame, frame);
+    if (res == -ENOBUFS) {
+        // Keep the frame until the caller provides a larger buffer
+        demuxer->hold();
+    } else {
+        demuxer->pop();
+    }
+
+    return res;
+}
+
+JNIEXPORT jobject JNICALL
+nativeProbeBandwidth(JNIEnv *env, jobject thiz, jint durationInMs, jlong maxBytes) {
+    rtmp_context *rtmp_context = RtmpWrapper::getNative(env, thiz);
+    if (rtmp_context == nullptr) {
+        return nullptr;
+    }
+
+    bandwidth_probe_result result = {0};
+    TRACE_BEGIN("rtmp.probe_bandwidth");
+    int res = BandwidthProbe::run(rtmp_context->rtmp, durationInMs, maxBytes, &result);
+    TRACE_END();
+    if (res != 0) {
+        LOGE("Can't probe bandwidth");
+        return nullptr;
+    }
+
+    return BandwidthProbeResult::getJava(env, result);
+}
+
 JNIEXPORT void JNICALL
 nativeClose(JNIEnv *env, jobject thiz) {
     rtmp_context *rtmp_context = RtmpWrapper::getNative(env, thiz);
 
     if (rtmp_context != nullptr) {
+        delete rtmp_context->demuxer;
+        rtmp_context->demuxer = nullptr;
+
         if (rtmp_context->rtmp != nullptr) {
             RTMP_Close(rtmp_context->rtmp);
             RTMP_Free(rtmp_context->rtmp);
@@ -353,6 +455,10 @@ static JNINativeMethod rtmpMethods[] = {{"nativeAlloc",            "()J",
                                         {"nativeRead",             "([BII)I",                    (void *) &nativeRead},
                                         {"nativeWritePacket",      "(L" RTMP_PACKET_CLASS";)I",  (void *) &nativeWritePacket},
                                         {"nativeReadPacket",       "()L" RTMP_PACKET_CLASS";",   (void *) &nativeReadPacket},
+                                        {"nativeSetJitterBufferDepth", "(I)I",                   (void *) &nativeSetJitterBufferDepth},
+                                        {"nativeGetJitterBufferDepth", "()I",                    (void *) &nativeGetJitterBufferDepth},
+                                        {"nativeReadFrame",        "(L" RTMP_FRAME_CLASS";)I",   (void *) &nativeReadFrame},
+                                        {"nativeProbeBandwidth",   "(IJ)L" BANDWIDTH_PROBE_RESULT_CLASS";", (void *) &nativeProbeBandwidth},
                                         {"nativeClose",            "()V",                        (void *) &nativeClose},
                                         {"nativeServe",            "(I)I",                       (void *) &nativeServe}};
 
@@ -543,6 +649,11 @@ jint JNI_OnLoad(JavaVM *vm, void * /*reserved*/) {
         return -1;
     }
 
+    if (!RtmpFrame::init(env)) {
+        LOGE("Can't initialize RtmpFrame");
+        return -1;
+    }
+
     if ((registerNativeForClassName(env, AMF_ENCODER_CLASS, amfEncoderMethods,
                                     sizeof(amfEncoderMethods) / sizeof(amfEncoderMethods[0])) !=
          JNI_TRUE)) {
@@ -554,6 +665,9 @@ jint JNI_OnLoad(JavaVM *vm, void * /*reserved*/) {
     RTMP_LogSetCallback(rtmp_log_cb);
     //RTMP_LogSetLevel(RTMP_LOGDEBUG);
 
+    // Register tracing
+    TRACE_INIT();
+
     return JNI_VERSION_1_6;
 }
 
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../Log.h"
+#include "../BandwidthProbe.h"
+
+#define BANDWIDTH_PROBE_RESULT_CLASS "video/api/rtmpdroid/BandwidthProbeResult"
+
+class BandwidthProbeResult {
+public:
+    static jobject getJava(JNIEnv *env, const bandwidth_probe_result result) {
+        jclass resultClz = env->FindClass(BANDWIDTH_PROBE_RESULT_CLASS);
+        if (!resultClz) {
+            LOGE("Can't find BandwidthProbeResult class");
+            return nullptr;
+        }
+
+        jmethodID resultConstructor = env->GetMethodID(resultClz, "<init>", "(JJJJJ)V");
+        if (!resultConstructor) {
+            LOGE("Can't get BandwidthProbeResult constructor");
+            env->DeleteLocalRef(resultClz);
+            return nullptr;
+        }
+
+        jobject bandwidthProbeResult = env->NewObject(resultClz, resultConstructor,
+                                                      (jlong) result.bytes_sent,
+                                                      (jlong) result.bytes_acked,
+                                                      (jlong) result.duration_us,
+                                                      (jlong) result.rtt_us,
+                                                      (jlong) result.rtt_var_us);
+        env->DeleteLocalRef(resultClz);
+        return bandwidthProbeResult;
+    }
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+class RtmpDemuxer;
+
 typedef struct rtmp_context {
     RTMP *rtmp;
+    RtmpDemuxer *demuxer;
 } rtmp_context;
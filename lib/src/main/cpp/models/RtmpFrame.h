@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string.h>
+
+#include "../Log.h"
+#include "../RtmpDemuxer.h"
+
+#define RTMP_FRAME_CLASS "video/api/rtmpdroid/RtmpFrame"
+
+class RtmpFrame {
+public:
+    /**
+     * Looks up RtmpFrame field IDs once, so that [setJava] does not look them up on each frame.
+     *
+     * @return true on success, false otherwise
+     */
+    static bool init(JNIEnv *env) {
+        jclass rtmpFrameClz = env->FindClass(RTMP_FRAME_CLASS);
+        if (!rtmpFrameClz) {
+            LOGE("Can't find RtmpFrame class");
+            return false;
+        }
+
+        field_ids &ids = fieldIds();
+        ids.buffer = env->GetFieldID(rtmpFrameClz, "buffer", "Ljava/nio/ByteBuffer;");
+        ids.size = env->GetFieldID(rtmpFrameClz, "size", "I");
+        ids.type = env->GetFieldID(rtmpFrameClz, "typeValue", "I");
+        ids.codec = env->GetFieldID(rtmpFrameClz, "codec", "I");
+        ids.timestamp = env->GetFieldID(rtmpFrameClz, "timestamp", "I");
+        ids.compositionTime = env->GetFieldID(rtmpFrameClz, "compositionTime", "I");
+        ids.isKeyFrame = env->GetFieldID(rtmpFrameClz, "isKeyFrame", "Z");
+        ids.isConfig = env->GetFieldID(rtmpFrameClz, "isConfig", "Z");
+
+        env->DeleteLocalRef(rtmpFrameClz);
+
+        if (!ids.buffer || !ids.size || !ids.type || !ids.codec || !ids.timestamp ||
+            !ids.compositionTime || !ids.isKeyFrame || !ids.isConfig) {
+            LOGE("Can't get RtmpFrame fields");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Copies a demuxed frame to a Java RtmpFrame.
+     *
+     * If the RtmpFrame buffer is too small, only its size is set so that the caller can grow it.
+     *
+     * @return frame size on success, -ENOBUFS if the RtmpFrame buffer is too small, -1 otherwise
+     */
+    static int setJava(JNIEnv *env, jobject rtmpFrame, const demuxed_frame *frame) {
+        const field_ids &ids = fieldIds();
+
+        int size = (int) frame->data.size();
+        env->SetIntField(rtmpFrame, ids.size, size);
+
+        jobject buffer = env->GetObjectField(rtmpFrame, ids.buffer);
+        char *buf = (char *) env->GetDirectBufferAddress(buffer);
+        jlong capacity = env->GetDirectBufferCapacity(buffer);
+        env->DeleteLocalRef(buffer);
+        if (buf == nullptr) {
+            LOGE("RtmpFrame buffer must be a direct buffer");
+            return -1;
+        }
+        if (capacity < size) {
+            return -ENOBUFS;
+        }
+
+        memcpy(buf, frame->data.data(), size);
+        env->SetIntField(rtmpFrame, ids.type, frame->type);
+        env->SetIntField(rtmpFrame, ids.codec, frame->codec);
+        env->SetIntField(rtmpFrame, ids.timestamp, (int32_t) frame->timestamp);
+        env->SetIntField(rtmpFrame, ids.compositionTime, frame->composition_time);
+        env->SetBooleanField(rtmpFrame, ids.isKeyFrame, frame->is_key_frame);
+        env->SetBooleanField(rtmpFrame, ids.isConfig, frame->is_config);
+
+        return size;
+    }
+
+private:
+    typedef struct field_ids {
+        jfieldID buffer;
+        jfieldID size;
+        jfieldID type;
+        jfieldID codec;
+        jfieldID timestamp;
+        jfieldID compositionTime;
+        jfieldID isKeyFrame;
+        jfieldID isConfig;
+    } field_ids;
+
+    static field_ids &fieldIds() {
+        static field_ids ids = {nullptr};
+        return ids;
+    }
+};
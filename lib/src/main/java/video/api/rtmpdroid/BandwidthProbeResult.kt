@@ -0,0 +1,52 @@
+package video.api.rtmpdroid
+
+/**
+ * Result of an uplink bandwidth probe.
+ *
+ * Byte counts are RTMP bytes on the wire, chunk headers included. TCP/IP overhead is not counted.
+ *
+ * @param bytesSent number of bytes the socket had to send during the probe: padding and bytes that
+ * were already queued when the probe started
+ * @param bytesAcked number of [bytesSent] acknowledged by the peer
+ * @param durationInUs probe duration in µs
+ * @param rttInUs smoothed round trip time from `TCP_INFO` in µs, or -1 if unavailable
+ * @param rttVarianceInUs round trip time variance from `TCP_INFO` in µs, or -1 if unavailable
+ * @see [Rtmp.probeBandwidth]
+ */
+class BandwidthProbeResult(
+    val bytesSent: Long,
+    val bytesAcked: Long,
+    val durationInUs: Long,
+    val rttInUs: Long,
+    val rttVarianceInUs: Long
+) {
+    /**
+     * Measured uplink throughput in bits per second
+     */
+    val throughput: Long
+        get() = if (durationInUs > 0) {
+            bytesAcked * 8 * 1_000_000 / durationInUs
+        } else {
+            0
+        }
+
+    /**
+     * Recommended starting bitrate in bits per second.
+     *
+     * @param ratio part of the measured [throughput] to use, to keep room for audio, RTMP overhead
+     * and bandwidth variations
+     * @return recommended bitrate in bits per second
+     */
+    fun recommendedBitrate(ratio: Float = DEFAULT_BITRATE_RATIO): Int {
+        require(ratio > 0 && ratio <= 1) { "Ratio must be in ]0, 1]" }
+        return (throughput * ratio).toLong().coerceAtMost(Int.MAX_VALUE.toLong()).toInt()
+    }
+
+    override fun toString(): String {
+        return "BandwidthProbeResult(bytesSent=$bytesSent, bytesAcked=$bytesAcked, durationInUs=$durationInUs, rttInUs=$rttInUs, rttVarianceInUs=$rttVarianceInUs, throughput=$throughput)"
+    }
+
+    companion object {
+        private const val DEFAULT_BITRATE_RATIO = 0.7f
+    }
+}
@@ -1,5 +1,7 @@
 package video.api.rtmpdroid
 
+import android.os.Trace
+import android.system.OsConstants
 import video.api.rtmpdroid.internal.ExVideoCodecs
 import video.api.rtmpdroid.internal.VideoCodecs
 import java.io.Closeable
@@ -15,6 +17,10 @@ import java.nio.ByteBuffer
  */
 class Rtmp(private val enableWrite: Boolean = true) : Closeable {
     companion object {
+        private const val DEFAULT_PROBE_DURATION_MS = 500
+        private const val DEFAULT_PROBE_MAX_BITRATE = 20_000_000
+        private const val QUEUE_TRACE_SECTION = "rtmp.queue"
+
         init {
             RtmpNativeLoader
         }
@@ -66,6 +72,37 @@ class Rtmp(private val enableWrite: Boolean = true) : Closeable {
             }
         }
 
+    private external fun nativeGetJitterBufferDepth(): Int
+    private external fun nativeSetJitterBufferDepth(depthInMs: Int): Int
+
+    /**
+     * Set/get the depth of the jitter buffer used by [readFrame] in ms.
+     *
+     * Received frames are reordered by timestamp and a frame is only returned once the jitter
+     * buffer spans at least this depth. Default is 0: frames are returned as soon as they are
+     * received.
+     */
+    var jitterBufferDepth: Int
+        /**
+         * @return jitter buffer depth in ms
+         */
+        get() {
+            val depth = nativeGetJitterBufferDepth()
+            if (depth < 0) {
+                throw UnsupportedOperationException("Can't get jitter buffer depth")
+            }
+            return depth
+        }
+        /**
+         * @param value jitter buffer depth in ms
+         */
+        set(value) {
+            require(value >= 0) { "Jitter buffer depth must be positive" }
+            if (nativeSetJitterBufferDepth(value) != 0) {
+                throw UnsupportedOperationException("Can't set jitter buffer depth")
+            }
+        }
+
     private external fun nativeGetExVideoCodecs(): String?
     private external fun nativeSetExVideoCodec(exVideoCodec: String?): Int
 
@@ -171,6 +208,36 @@ class Rtmp(private val enableWrite: Boolean = true) : Closeable {
         }
     }
 
+    private external fun nativeProbeBandwidth(durationInMs: Int, maxBytes: Long): BandwidthProbeResult?
+
+    /**
+     * Probes the uplink bandwidth to choose a starting bitrate.
+     *
+     * Call it after [connectStream] and before the first [write]. It sends padding user control
+     * messages that the server ignores for up to [durationInMs] (or until [maxBitrate] would be
+     * exceeded), then waits up to [durationInMs] for the socket send queue to drain. Padding is
+     * paced on the bytes not sent yet by the socket, so at most a few dozen kB of padding are left
+     * ahead of the first frame. Bytes in flight are not limited, so that the probe is not capped by
+     * the round trip time.
+     *
+     * @param durationInMs duration of the padding burst in ms
+     * @param maxBitrate highest bitrate to probe in bits per second
+     * @return the probe result. See [BandwidthProbeResult.recommendedBitrate].
+     */
+    fun probeBandwidth(
+        durationInMs: Int = DEFAULT_PROBE_DURATION_MS,
+        maxBitrate: Int = DEFAULT_PROBE_MAX_BITRATE
+    ): BandwidthProbeResult {
+        require(durationInMs > 0) { "Probe duration must be positive" }
+        require(maxBitrate > 0) { "Probe max bitrate must be positive" }
+
+        val maxBytes = maxBitrate.toLong() * durationInMs / 8000
+        val result = synchronized(this) {
+            nativeProbeBandwidth(durationInMs, maxBytes)
+        }
+        return result ?: throw SocketException("Failed to probe bandwidth")
+    }
+
     private external fun nativeWrite(buffer: ByteBuffer, offset: Int, size: Int): Int
 
     /**
@@ -182,7 +249,13 @@ class Rtmp(private val enableWrite: Boolean = true) : Closeable {
     fun write(buffer: ByteBuffer): Int {
         require(buffer.isDirect) { "ByteBuffer must be a direct buffer" }
 
+        if (BuildConfig.ENABLE_TRACING) {
+            Trace.beginSection(QUEUE_TRACE_SECTION) // Waiting for previous frames to be sent
+        }
         val byteSent = synchronized(this) {
+            if (BuildConfig.ENABLE_TRACING) {
+                Trace.endSection()
+            }
             nativeWrite(buffer, buffer.position(), buffer.remaining())
         }
         when {
@@ -209,7 +282,13 @@ class Rtmp(private val enableWrite: Boolean = true) : Closeable {
      * @return number of bytes sent
      */
     fun write(array: ByteArray, offset: Int = 0, size: Int = array.size): Int {
+        if (BuildConfig.ENABLE_TRACING) {
+            Trace.beginSection(QUEUE_TRACE_SECTION) // Waiting for previous frames to be sent
+        }
         val byteSent = synchronized(this) {
+            if (BuildConfig.ENABLE_TRACING) {
+                Trace.endSection()
+            }
             nativeWrite(array, offset, size)
         }
         when {
@@ -279,6 +358,42 @@ class Rtmp(private val enableWrite: Boolean = true) : Closeable {
         }
     }
 
+    private external fun nativeReadFrame(frame: RtmpFrame): Int
+
+    /**
+     * Reads the next audio, video or metadata frame of a played stream.
+     *
+     * Frames are demuxed natively and returned in timestamp order, after the jitter buffer
+     * (see [jitterBufferDepth]). The payload is copied to [RtmpFrame.buffer]: reuse the same
+     * [frame] between calls to avoid allocations.
+     *
+     * @param frame the [RtmpFrame] to fill
+     * @return [frame] with its buffer limit set to the frame size
+     */
+    fun readFrame(frame: RtmpFrame): RtmpFrame {
+        var res = nativeReadFrame(frame)
+        if (res == -OsConstants.ENOBUFS) {
+            // Native side holds the frame that did not fit: retry returns the same frame
+            frame.ensureCapacity(frame.size)
+            res = nativeReadFrame(frame)
+        }
+        when {
+            res == -OsConstants.ETIMEDOUT -> {
+                throw SocketTimeoutException("Timeout exception")
+            }
+
+            res < 0 -> {
+                throw SocketException("Failed to read frame")
+            }
+
+            else -> {
+                frame.buffer.clear()
+                frame.buffer.limit(res)
+                return frame
+            }
+        }
+    }
+
     private external fun nativePause(): Int
 
     /**
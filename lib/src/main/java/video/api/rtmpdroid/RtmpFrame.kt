@@ -0,0 +1,87 @@
+package video.api.rtmpdroid
+
+import java.nio.ByteBuffer
+
+/**
+ * A demuxed frame of a played stream.
+ *
+ * A [RtmpFrame] is meant to be reused for every call to [Rtmp.readFrame]: its [buffer] is only
+ * reallocated when a frame does not fit in it.
+ *
+ * @param capacity initial capacity of [buffer] in bytes
+ */
+class RtmpFrame(capacity: Int = DEFAULT_CAPACITY) {
+    /**
+     * Frame payload without its FLV audio/video header, in a direct [ByteBuffer].
+     * Valid until next [Rtmp.readFrame].
+     */
+    var buffer: ByteBuffer = ByteBuffer.allocateDirect(capacity)
+        private set
+
+    /**
+     * Size of the frame in bytes. Set by native code.
+     */
+    internal var size: Int = 0
+
+    private var typeValue: Int = FrameType.AUDIO.value
+
+    /**
+     * Frame type
+     */
+    val type: FrameType
+        get() = FrameType.fromValue(typeValue)
+
+    /**
+     * FLV codec ID (`SoundFormat` or `CodecID`) or FourCC for enhanced RTMP video.
+     */
+    var codec: Int = 0
+        private set
+
+    /**
+     * Decoding timestamp in ms
+     */
+    var timestamp: Int = 0
+        private set
+
+    /**
+     * Composition time offset in ms. Presentation timestamp is [timestamp] + [compositionTime].
+     */
+    var compositionTime: Int = 0
+        private set
+
+    /**
+     * Whether the frame is a key frame. Always true for audio frames.
+     */
+    var isKeyFrame: Boolean = false
+        private set
+
+    /**
+     * Whether the frame is a codec configuration (sequence header) rather than media data.
+     */
+    var isConfig: Boolean = false
+        private set
+
+    internal fun ensureCapacity(capacity: Int) {
+        if (buffer.capacity() < capacity) {
+            buffer = ByteBuffer.allocateDirect(capacity)
+        }
+    }
+
+    companion object {
+        private const val DEFAULT_CAPACITY = 64 * 1024
+    }
+}
+
+/**
+ * Demuxed frame type
+ * @param value native int equivalent
+ */
+enum class FrameType(val value: Int) {
+    AUDIO(0),
+    VIDEO(1),
+    METADATA(2);
+
+    companion object {
+        fun fromValue(value: Int) = values().first { it.value == value }
+    }
+}
@@ -0,0 +1,35 @@
+package video.api.rtmpdroid
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.fail
+import org.junit.Test
+
+class BandwidthProbeResultTest {
+    @Test
+    fun `test throughput`() {
+        val result = BandwidthProbeResult(200_000, 125_000, 1_000_000, 20_000, 5_000)
+        assertEquals(1_000_000L, result.throughput)
+    }
+
+    @Test
+    fun `test throughput with zero duration`() {
+        val result = BandwidthProbeResult(200_000, 125_000, 0, 20_000, 5_000)
+        assertEquals(0L, result.throughput)
+    }
+
+    @Test
+    fun `test recommendedBitrate`() {
+        val result = BandwidthProbeResult(200_000, 125_000, 500_000, 20_000, 5_000)
+        assertEquals(1_000_000, result.recommendedBitrate(0.5f))
+    }
+
+    @Test
+    fun `test recommendedBitrate with invalid ratio`() {
+        val result = BandwidthProbeResult(200_000, 125_000, 500_000, 20_000, 5_000)
+        try {
+            result.recommendedBitrate(1.5f)
+            fail("IllegalArgumentException should be thrown for ratio > 1")
+        } catch (_: IllegalArgumentException) {
+        }
+    }
+}